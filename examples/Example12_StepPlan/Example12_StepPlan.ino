@@ -0,0 +1,75 @@
+/*
+  Control a bi-polar stepper motor using the SparkFun ProDriver TC78H670FTG
+  By: SparkFun Electronics
+  Date: October 19th, 2026
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  This example compiles a move (with a speed ramp at each end) into a step plan ahead of time,
+  and then plays it back and forth. Working out the step timing before the move starts
+  leaves very little work to do on each step, which allows for faster stepping on small
+  microcontrollers. It also prints how long the compile took and how much memory the plan uses.
+
+  To step a plan from your own timer interrupt instead of playStepPlan(), call startStepPlan(plan)
+  first (it sets the direction pin and enables the driver), then in the interrupt call
+  stepPlanPulse(plan) and set the timer for the next stepPlanNextInterval(plan) uSec,
+  stopping when it returns 0.
+
+  Feel like supporting open source hardware?
+  Buy a board from SparkFun! https://www.sparkfun.com/products/16836
+
+  Hardware Connections:
+
+  ARDUINO --> PRODRIVER
+  D8 --> STBY
+  D7 --> EN
+  D6 --> MODE0
+  D5 --> MODE1
+  D4 --> MODE2
+  D3 --> MODE3
+  D2 --> ERR
+
+*/
+
+#include "SparkFun_ProDriver_TC78H670FTG_Arduino_Library.h" //Click here to get the library: http://librarymanager/All#SparkFun_ProDriver
+PRODRIVER myProDriver; //Create instance of this object
+
+uint8_t planBufferCW[64]; // storage for the compiled moves
+uint8_t planBufferCCW[64];
+PRODRIVERStepPlan planCW;
+PRODRIVERStepPlan planCCW;
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("SparkFun ProDriver TC78H670FTG Example 12");
+
+  myProDriver.begin(); // default settings
+
+  // ramp from 4000uSec per step down to 1000uSec per step over the first 50 steps,
+  // and back up again over the last 50 steps
+  PRODRIVERSpeedProfile profile;
+  profile.startInterval = 4000;
+  profile.cruiseInterval = 1000;
+  profile.rampSteps = 50;
+
+  planCW.buffer = planBufferCW;
+  planCW.bufferSize = sizeof(planBufferCW);
+  planCCW.buffer = planBufferCCW;
+  planCCW.bufferSize = sizeof(planBufferCCW);
+
+  if (myProDriver.compileStepPlan(planCW, 400, 0, profile) == false) Serial.println("CW plan does not fit in buffer, it will not move");
+  if (myProDriver.compileStepPlan(planCCW, 400, 1, profile) == false) Serial.println("CCW plan does not fit in buffer, it will not move");
+
+  Serial.print("Compiled 400 steps in ");
+  Serial.print(planCW.compileMicros);
+  Serial.print(" uSec, using ");
+  Serial.print(planCW.length);
+  Serial.println(" bytes");
+}
+
+void loop() {
+  myProDriver.playStepPlan(planCW); // turn 400 steps, CW direction
+  delay(1000);
+  myProDriver.playStepPlan(planCCW); // turn 400 steps, CCW direction
+  delay(1000);
+}
@@ -0,0 +1,66 @@
+/*
+  Control a bi-polar stepper motor using the SparkFun ProDriver TC78H670FTG
+  By: SparkFun Electronics
+  Date: October 19th, 2026
+  License: MIT. See license file for more information but you can
+  basically do whatever you want with this code.
+
+  This example moves the motor to absolute positions with moveTo(), while changing step resolution.
+  The library keeps track of position in 1/128ths of a step (the finest microstep),
+  so a position means the same thing at any step resolution.
+  
+  Feel like supporting open source hardware?
+  Buy a board from SparkFun! https://www.sparkfun.com/products/16836
+
+  Hardware Connections:
+
+  ARDUINO --> PRODRIVER
+  D8 --> STBY
+  D7 --> EN
+  D6 --> MODE0
+  D5 --> MODE1
+  D4 --> MODE2
+  D3 --> MODE3
+  D2 --> ERR
+
+*/
+
+#include "SparkFun_ProDriver_TC78H670FTG_Arduino_Library.h" //Click here to get the library: http://librarymanager/All#SparkFun_ProDriver
+PRODRIVER myProDriver; //Create instance of this object
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("SparkFun ProDriver TC78H670FTG Example 13");
+
+  //***** Configure the ProDriver's Settings *****//
+  // Note, we must change settings BEFORE calling the .begin() function.
+  // For this example, we will use variable 1/8 step resolution,
+  // so we can change between 1:1, 1:2, 1:4 and 1:8 during operation.
+  myProDriver.settings.stepResolutionMode = PRODRIVER_STEP_RESOLUTION_VARIABLE_1_8;
+
+  myProDriver.begin(); // adjust custom settings before calling this
+  myProDriver.setPosition(0); // call wherever your motor is now "home"
+}
+
+void loop() {
+  myProDriver.changeStepResolution(PRODRIVER_STEP_RESOLUTION_1_1);
+  myProDriver.moveTo(200L * PRODRIVER_POSITION_UNITS_PER_STEP); // 200 full steps from home
+  printPosition();
+  delay(1000);
+
+  myProDriver.changeStepResolution(PRODRIVER_STEP_RESOLUTION_1_8);
+  myProDriver.moveBy(-50L * PRODRIVER_POSITION_UNITS_PER_STEP); // back 50 full steps (400 steps at 1:8)
+  printPosition();
+  delay(1000);
+
+  myProDriver.changeStepResolution(PRODRIVER_STEP_RESOLUTION_1_2);
+  myProDriver.moveTo(0); // all the way back home
+  printPosition();
+  delay(1000);
+}
+
+void printPosition( void )
+{
+  Serial.print("Position (full steps): ");
+  Serial.println(myProDriver.getPosition() / PRODRIVER_POSITION_UNITS_PER_STEP);
+}
@@ -31,6 +31,10 @@
 #include "Arduino.h"
 #include <stdint.h>
 
+// phaseA and phaseB bits for each phasePosition (1,2,3,4), see stepSerialSingle()
+static const uint8_t phaseAForPosition[4] = {1, 0, 0, 1};
+static const uint8_t phaseBForPosition[4] = {1, 1, 0, 0};
+
 //****************************************************************************//
 //
 //  Constructor
@@ -58,6 +62,7 @@ PRODRIVER::PRODRIVER( void )
   settings.mixedDecayB = PRODRIVER_MD_FAST_37;
   settings.phasePosition = 1;
   settings.fastSerialMode = false; // default to false
+  settings.autoCommit = true; // main loop functions commit settings for you, see commitSettings()
 
   //Select default arduino pin numbers for hardware connections
 	settings.mode0Pin =   PRODRIVER_DEFAULT_PIN_MODE_0;
@@ -72,14 +77,29 @@ PRODRIVER::PRODRIVER( void )
   settings.enableStatus = PRODRIVER_STATUS_DISABLED;  
   settings.standbyStatus = PRODRIVER_STATUS_STANDBY_ON;
   settings.errorFlag = false; // false = no error
+
+  // fill the committed settings, so there is always a valid copy to read
+  activeBuffer = 0;
+  commitCount = 0;
+  commitSettings();
+
+  position = 0;
+  updatePositionIncrement();
 }
 
 //Initializes the motor driver with basic settings
 //Returns false if error is detected (i.e. ERR pin is pulled low by the IC)
+//Note, calling begin() again (i.e. to change controlMode) puts the IC through standby,
+//which resets its electrical angle, so the motor may jump. Position keeps counting
+//from its old value, but that is no longer where the motor is: home again and
+//call setPosition() after every begin() but the first.
 bool PRODRIVER::begin( void )
 {
+  commitSettings(); // pick up any settings changed before begin()
   pinSetup(); // sets arduino pins to necessary initial pinModes and statuses
   controlModeSelect(); // "boots up" IC with correct statuses on MODE pins
+  settings.stepResolution = PRODRIVER_STEP_RESOLUTION_1_1; // IC always boots up at 1:1 in the "variable" modes
+  updatePositionIncrement(); // control mode and step resolution mode are now fixed
 
   return errorStat(); //We're all setup!
 }
@@ -241,19 +261,8 @@ bool PRODRIVER::errorStat( void )
 bool PRODRIVER::step( uint16_t steps, bool direction, uint8_t clockDelay)
 {
   enable();
-
-  // set CW-CWW pin (aka mode3Pin) to the desired direction
-  // CW-CCW pin controls the rotation direction of the motor. 
-  // When set to H, the current of OUT_A is output first, with a phase difference of 90°. 
-  // When set to L, the current of OUT_B is output first with a phase difference of 90°
-  if(direction == true)
-  {
-    pinMode(settings.mode3Pin, INPUT); // let on-board external pullup to 3.3V pull this pin HIGH
-  }
-  else{
-    pinMode(settings.mode3Pin, OUTPUT);
-    digitalWrite(settings.mode3Pin, LOW);
-  }
+  setDirection(direction);
+  int16_t positionDelta = direction ? positionIncrement : -positionIncrement;
   
   // step the motor the desired amount of steps
   // each up-edge of the CLK signal (aka mode2Pin) 
@@ -265,6 +274,7 @@ bool PRODRIVER::step( uint16_t steps, bool direction, uint8_t clockDelay)
     delayMicroseconds(1); // even out the clock signal, error check takes about 2uSec
     delay(clockDelay);
     pinMode(settings.mode2Pin, INPUT); // let on-board external pullup to 3.3V pull this pin HIGH
+    position += positionDelta;
     // check for error
     if(errorStat() == false) return false; // error detected, exit out of here!
     delay(clockDelay);
@@ -272,6 +282,41 @@ bool PRODRIVER::step( uint16_t steps, bool direction, uint8_t clockDelay)
   return errorStat();
 }
 
+// setDirection( bool direction )
+// using CLOCKIN mode,
+// set CW-CWW pin (aka mode3Pin) to the desired direction
+// CW-CCW pin controls the rotation direction of the motor. 
+// When set to H, the current of OUT_A is output first, with a phase difference of 90°. 
+// When set to L, the current of OUT_B is output first with a phase difference of 90°
+void PRODRIVER::setDirection( bool direction )
+{
+  if(direction == true)
+  {
+    pinMode(settings.mode3Pin, INPUT); // let on-board external pullup to 3.3V pull this pin HIGH
+  }
+  else{
+    pinMode(settings.mode3Pin, OUTPUT);
+    digitalWrite(settings.mode3Pin, LOW);
+  }
+}
+
+// clockPulse( int16_t positionDelta )
+// using CLOCKIN mode,
+// send a single short clock pulse (aka mode2Pin) for one step,
+// and move position by positionDelta.
+// Unlike step(), this does not hold the clock low for half of the step,
+// so it can be used by timed playback (and from a timer ISR).
+// returns errorStat()
+bool PRODRIVER::clockPulse( int16_t positionDelta )
+{
+  pinMode(settings.mode2Pin, OUTPUT);
+  digitalWrite(settings.mode2Pin, LOW);
+  delayMicroseconds(1);
+  pinMode(settings.mode2Pin, INPUT); // let on-board external pullup to 3.3V pull this pin HIGH, the up-edge steps the motor
+  position += positionDelta;
+  return errorStat();
+}
+
 // changeStepResolution( uint8_t resolution)
 // Step resolution can be changed during operating.
 // Step resolution can be set by SET_EN pin and UP-DW pin. 
@@ -283,6 +328,15 @@ bool PRODRIVER::changeStepResolution( uint8_t resolution)
   // just return errorStat()
   if(settings.stepResolution == resolution) return errorStat();
 
+  // only CLOCKIN mode with a "variable" step resolution mode can change,
+  // and only to a power of two from 1:1 up to the finest resolution of that mode
+  // (i.e. PRODRIVER_STEP_RESOLUTION_VARIABLE_1_8 allows 1:1, 1:2, 1:4 and 1:8).
+  // Anything else is rejected, so the position stays exact.
+  if(settings.controlMode != PRODRIVER_MODE_CLOCKIN) return false;
+  if(settings.stepResolutionMode >= PRODRIVER_STEP_RESOLUTION_FIXED_FULL) return false;
+  if((resolution == 0) || ((resolution & (resolution - 1)) != 0)) return false;
+  if(resolution > (1 << settings.stepResolutionMode)) return false;
+
 
   // convert pin names to CLOCKIN specific names
   // (for ease of programming)
@@ -340,6 +394,7 @@ bool PRODRIVER::changeStepResolution( uint8_t resolution)
 
   // update setting member so we can compare next time we change
   settings.stepResolution = resolution;
+  updatePositionIncrement(); // so position stays in 1/128 steps at the new resolution
   
   return errorStat();
 }
@@ -389,32 +444,61 @@ bool PRODRIVER::disable( void )
 // Note, you must first adjust all of your desired settings by accessing
 // the members within PRODRIVERSetting, and then call this function
 // to actually send a fresh new command.
+// This commits settings first (unless settings.autoCommit is false, see commitSettings()).
 bool PRODRIVER::sendSerialCommand( void )
 {
-  // first lets construct the 32 bit data package that we need to send.
-  // we will do this by taking in all of the settings and plugging them
-  // into the correct bits.
-  
-  uint32_t command = 0; // start fresh
+  if(settings.autoCommit == true) commitSettings();
+  sendCommittedCommand();
+
+  //return errorStat();
+  return true;
+}
+
+// sendCommittedCommand ( void )
+// send the serial command built at the last commitSettings(), plus the current phaseA/phaseB.
+// This doesn't touch the committed settings, so the step functions use it
+// (and it is safe to call from an ISR while settings are being committed).
+void PRODRIVER::sendCommittedCommand( void )
+{
+  uint32_t command = readCommittedCommand();
 
   // set the phase bits
-  command |= (settings.phaseA << 2);
+  command |= ((uint32_t)settings.phaseA << 2);
   command |= ((uint32_t)settings.phaseB << 18);
 
+  writeSerialCommand(command);
+}
+
+// buildSerialCommand( const PRODRIVERSettings &source )
+// construct the 32 bit data package that we need to send.
+// we will do this by taking in all of the settings and plugging them
+// into the correct bits.
+// the phase bits are left clear, sendSerialCommand() adds them.
+uint32_t PRODRIVER::buildSerialCommand( const PRODRIVERSettings &source )
+{
+  uint32_t command = 0; // start fresh
+
   // set the current limits
-  command |= (settings.currentLimA << 3);
-  command |= ((uint32_t)settings.currentLimB << 19);
+  command |= ((uint32_t)source.currentLimA << 3);
+  command |= ((uint32_t)source.currentLimB << 19);
 
   // set the torque bits
-  command |= ((uint32_t)settings.torque << 29);
+  command |= ((uint32_t)source.torque << 29);
 
   // set the open detection bit
-  command |= ((uint32_t)settings.openDetection << 31);
+  command |= ((uint32_t)source.openDetection << 31);
 
   // set the mixed decay bits
-  command |= settings.mixedDecayA; // bit 0, no shift necessary
-  command |= ((uint32_t)settings.mixedDecayB << 16);
+  command |= source.mixedDecayA; // bit 0, no shift necessary
+  command |= ((uint32_t)source.mixedDecayB << 16);
 
+  return command;
+}
+
+// writeSerialCommand( uint32_t command )
+// shift out a 32 bit data package to the driver IC and latch it
+void PRODRIVER::writeSerialCommand( uint32_t command )
+{
   // write the data 
   // check for fast serial mode
   if(settings.fastSerialMode == true)
@@ -469,9 +553,6 @@ bool PRODRIVER::sendSerialCommand( void )
   }
 
   //Serial.println(command, BIN);
-  
-  //return errorStat();
-  return true;
 }
 
 // stepSerial( uint16_t steps, bool direction, uint8_t stepDelay )
@@ -483,6 +564,7 @@ bool PRODRIVER::sendSerialCommand( void )
 
 bool PRODRIVER::stepSerial(uint16_t steps, bool direction, uint8_t stepDelay)
 {
+  if(settings.autoCommit == true) commitSettings(); // pick up any settings changed directly
   enable();
   for(int i = 0; i < steps ; i++)
   {
@@ -507,53 +589,42 @@ bool PRODRIVER::stepSerialSingle(bool direction)
 
   // check for error
   if(settings.errorFlag) return false;
-  
+
+  if(advancePhase(direction) == false) return false;
+  sendCommittedCommand();
+  return true;
+}
+
+// advancePhase( bool direction )
+// move phasePosition one step in the desired direction (rolling over 1-4)
+// and update phaseA/phaseB (and position) to match
+// returns false (and changes nothing) if phasePosition is not 1,2,3 or 4
+bool PRODRIVER::advancePhase( bool direction )
+{
+  if((settings.phasePosition < 1) || (settings.phasePosition > 4)) return false;
+
   if(direction == true)
   {
     settings.phasePosition++;
     if(settings.phasePosition > 4) settings.phasePosition = 1; // roll over
+    position += PRODRIVER_POSITION_UNITS_PER_STEP; // SERIAL mode is always 1:1 stepping
   }
   else
   {
     settings.phasePosition--;
     if(settings.phasePosition < 1) settings.phasePosition = 4; // roll over
+    position -= PRODRIVER_POSITION_UNITS_PER_STEP;
   }
 
-  switch (settings.phasePosition)
-  {
-  case 1:
-    settings.phaseA = 1;
-    settings.phaseB = 1;
-    return sendSerialCommand();
-    break;
-
-  case 2:
-    settings.phaseA = 0;
-    settings.phaseB = 1;
-    return sendSerialCommand();
-    break;
-
-  case 3:
-    settings.phaseA = 0;
-    settings.phaseB = 0;
-    return sendSerialCommand();
-    break;
-
-  case 4:
-    settings.phaseA = 1;
-    settings.phaseB = 0;
-    return sendSerialCommand();
-    break;        
-
-  default:
-    return false;
-    break;
-  }
+  settings.phaseA = phaseAForPosition[settings.phasePosition - 1];
+  settings.phaseB = phaseBForPosition[settings.phasePosition - 1];
+  return true;
 }
 
 // setTorque( uint8_t newTorque )
-// This is simply a wrapper function to set desired torque setting
-// Note, this will only take effect on the motor driver when sendSerialCommand() is called.
+// This is simply a wrapper function to set desired torque setting (and commit it, if settings.autoCommit)
+// Note, this will only take effect on the motor driver when sendSerialCommand() is called,
+// or on the next step in SERIAL mode.
 // Valid torque options include the following:
 // PRODRIVER_TRQ_100 (default set in constructor)
 // PRODRIVER_TRQ_75
@@ -562,13 +633,15 @@ bool PRODRIVER::stepSerialSingle(bool direction)
 bool PRODRIVER::setTorque( uint8_t newTorque )
 {
   settings.torque = newTorque;
+  if(settings.autoCommit == true) commitSettings();
   return true;
 }
 
 // setCurrentLimit( uint16_t currentLimit )
-// This is simply a wrapper function to set desired current limit setting
+// This is simply a wrapper function to set desired current limit setting (and commit it, if settings.autoCommit)
 // Note, this effects current limit on both coils (A and B)
-// Note, this will only take effect on the motor driver when sendSerialCommand() is called.
+// Note, this will only take effect on the motor driver when sendSerialCommand() is called,
+// or on the next step in SERIAL mode.
 // currentLimit is a 10-bit value, so must be 0-1023
 // currentLimit is a percentage of VREF and also limited by torque setting.
 bool PRODRIVER::setCurrentLimit( uint16_t currentLimit )
@@ -580,5 +653,410 @@ bool PRODRIVER::setCurrentLimit( uint16_t currentLimit )
   }
   settings.currentLimA = currentLimit;
   settings.currentLimB = currentLimit;
+  if(settings.autoCommit == true) commitSettings();
+  return true;
+}
+
+// commitSettings( void )
+// copy settings into the committed settings double buffer in one atomic step.
+// The copy goes into the inactive half of the buffer, and only then is activeBuffer
+// switched over (a single byte write, which is atomic on every Arduino),
+// so interrupts never have to be turned off.
+// What the double buffer covers:
+//   The serial command fields (currentLimA, currentLimB, torque, openDetection,
+//   mixedDecayA and mixedDecayB) are only ever sent from the committed copy,
+//   so a step taken from an ISR always uses one complete set of them.
+//   readSettings() returns a committed copy of every field.
+// What it does not cover (these are always read straight from settings):
+//   phaseA, phaseB and phasePosition (stepping state), controlMode, errorFlag,
+//   fastSerialMode, and the pin numbers.
+// begin() always commits. setTorque(), setCurrentLimit(), sendSerialCommand(), stepSerial(),
+// stepProfile(), startStepPlan() and playStepPlan() also commit for you, unless
+// settings.autoCommit is false. stepPlanPulse() never does, so changes made during
+// a timer-driven move take effect once they are committed.
+// Note, only commit from one context at a time (i.e. the main loop, or one ISR, not both).
+// If an ISR changes settings, set settings.autoCommit to false, so the main loop never
+// copies settings while the ISR is halfway through changing them, and have the ISR
+// stage its changes in its own PRODRIVERSettings and call commitSettings(staged).
+void PRODRIVER::commitSettings( void )
+{
+  commitSettings(settings);
+}
+
+// commitSettings( const PRODRIVERSettings &source )
+// same as commitSettings(), but commits source instead of settings
+void PRODRIVER::commitSettings( const PRODRIVERSettings &source )
+{
+  uint8_t next = activeBuffer ^ 1;
+  committed[next].settings = source;
+  committed[next].command = buildSerialCommand(committed[next].settings);
+  PRODRIVER_MEMORY_BARRIER();
+  activeBuffer = next;
+  commitCount++;
+  PRODRIVER_MEMORY_BARRIER();
+}
+
+// readSettings( PRODRIVERSettings &snapshot )
+// copy out the last committed settings.
+// If a commit happens (i.e. from an ISR) while we are copying, the copy is
+// thrown away and taken again, so snapshot is always exactly one committed set.
+void PRODRIVER::readSettings( PRODRIVERSettings &snapshot )
+{
+  PRODRIVERCommitCount count;
+  do
+  {
+    count = commitCount;
+    PRODRIVER_MEMORY_BARRIER();
+    snapshot = committed[activeBuffer].settings;
+    PRODRIVER_MEMORY_BARRIER();
+  } while(count != commitCount);
+}
+
+// readCommittedCommand( void )
+// same as readSettings(), but only for the serial command built at commit time
+uint32_t PRODRIVER::readCommittedCommand( void )
+{
+  PRODRIVERCommitCount count;
+  uint32_t command;
+  do
+  {
+    count = commitCount;
+    PRODRIVER_MEMORY_BARRIER();
+    command = committed[activeBuffer].command;
+    PRODRIVER_MEMORY_BARRIER();
+  } while(count != commitCount);
+  return command;
+}
+
+// profileInterval( uint16_t stepIndex, uint16_t steps, PRODRIVERSpeedProfile profile )
+// works out the step interval (in microseconds) for one step of a move.
+// The interval ramps linearly between startInterval and cruiseInterval
+// over the first and last rampSteps of the move.
+// Never returns 0, so that 0 can mark the end of a step plan.
+uint16_t PRODRIVER::profileInterval( uint16_t stepIndex, uint16_t steps, PRODRIVERSpeedProfile profile )
+{
+  // how far we are from the closest end of the move
+  uint16_t fromEdge = stepIndex;
+  if((uint16_t)(steps - 1 - stepIndex) < fromEdge) fromEdge = steps - 1 - stepIndex;
+
+  int32_t interval = profile.cruiseInterval;
+  if(fromEdge < profile.rampSteps)
+  {
+    interval = profile.startInterval + ((int32_t)profile.cruiseInterval - profile.startInterval) * fromEdge / profile.rampSteps;
+  }
+  if(interval < 1) interval = 1;
+  return (uint16_t)interval;
+}
+
+// waitInterval( uint32_t lastStepMicros, uint16_t interval )
+// wait until interval microseconds have passed since lastStepMicros
+// (micros() roll over is handled by the unsigned subtraction)
+void PRODRIVER::waitInterval( uint32_t lastStepMicros, uint16_t interval )
+{
+  while((uint32_t)(micros() - lastStepMicros) < interval)
+  {
+    // wait
+  }
+}
+
+// stepProfile( uint16_t steps, bool direction, PRODRIVERSpeedProfile profile )
+// step the motor a set amount of steps at the desired direction,
+// working out each step interval live from the speed profile.
+// Works in either control mode (SERIAL mode is 1:1 stepping only).
+// This produces the same steps and timing as compiling the move with compileStepPlan()
+// and playing it back with playStepPlan(), but it has more work to do on every step.
+// will stop if error is detected during stepping
+// retuns errorStat()
+bool PRODRIVER::stepProfile( uint16_t steps, bool direction, PRODRIVERSpeedProfile profile )
+{
+  if(settings.autoCommit == true) commitSettings(); // pick up any settings changed directly
+  enable();
+  if(settings.controlMode == PRODRIVER_MODE_CLOCKIN) setDirection(direction);
+  int16_t positionDelta = direction ? positionIncrement : -positionIncrement;
+
+  uint32_t lastStepMicros = micros();
+  for(uint16_t i = 0 ; i < steps ; i++)
+  {
+    uint16_t interval = profileInterval(i, steps, profile);
+    waitInterval(lastStepMicros, interval);
+    lastStepMicros += interval;
+    if(settings.controlMode == PRODRIVER_MODE_CLOCKIN)
+    {
+      if(clockPulse(positionDelta) == false) return false; // error detected, exit out of here!
+    }
+    else{
+      if(stepSerialSingle(direction) == false) return false;
+    }
+  }
+  return errorStat();
+}
+
+// compileStepPlan( PRODRIVERStepPlan &plan, uint16_t steps, bool direction, PRODRIVERSpeedProfile profile )
+// work out every step interval of a move ahead of time and store them in plan.buffer,
+// run-length/delta encoded (see PRODRIVER_PLAN_ESCAPE in the header).
+// A constant speed section costs 2 bytes per 255 steps, a ramp costs up to 2 bytes per step.
+// After compiling, plan.length is the memory used and plan.compileMicros the time taken.
+// returns false if plan.buffer is too small for the move,
+// in which case the plan is left empty (0 steps), so playing it does nothing.
+bool PRODRIVER::compileStepPlan( PRODRIVERStepPlan &plan, uint16_t steps, bool direction, PRODRIVERSpeedProfile profile )
+{
+  uint32_t startMicros = micros();
+
+  // leave the plan empty until the whole move has been encoded
+  plan.steps = 0;
+  plan.length = 0;
+  plan.compileMicros = 0;
+  plan.direction = direction;
+  plan.controlMode = settings.controlMode;
+  plan.stepResolution = settings.stepResolution;
+  plan.positionDelta = direction ? positionIncrement : -positionIncrement;
+  rewindStepPlan(plan);
+
+  uint16_t length = 0;
+  uint16_t previousInterval = 0;
+  bool runOpen = false;
+  int8_t runDelta = 0;
+  uint8_t runCount = 0;
+
+  for(uint16_t i = 0 ; i < steps ; i++)
+  {
+    uint16_t interval = profileInterval(i, steps, profile);
+    int32_t difference = (int32_t)interval - previousInterval;
+
+    if((runOpen == true) && (difference == runDelta) && (runCount < PRODRIVER_PLAN_MAX_RUN))
+    {
+      runCount++; // same change as the last step, so just make the run longer
+    }
+    else{
+      // close out the current run
+      if(runOpen == true)
+      {
+        if((length + 2) > plan.bufferSize) return false;
+        plan.buffer[length++] = (uint8_t)runDelta;
+        plan.buffer[length++] = runCount;
+      }
+
+      // too big of a change for a signed byte, so write the new interval out in full
+      if((difference < -127) || (difference > 127))
+      {
+        if((length + 3) > plan.bufferSize) return false;
+        plan.buffer[length++] = PRODRIVER_PLAN_ESCAPE;
+        plan.buffer[length++] = interval & 0xFF;
+        plan.buffer[length++] = interval >> 8;
+        difference = 0;
+      }
+
+      runOpen = true;
+      runDelta = (int8_t)difference;
+      runCount = 1;
+    }
+    previousInterval = interval;
+  }
+
+  // close out the last run
+  if(runOpen == true)
+  {
+    if((length + 2) > plan.bufferSize) return false;
+    plan.buffer[length++] = (uint8_t)runDelta;
+    plan.buffer[length++] = runCount;
+  }
+
+  plan.steps = steps;
+  plan.length = length;
+  plan.compileMicros = micros() - startMicros;
+  return true;
+}
+
+// rewindStepPlan( PRODRIVERStepPlan &plan )
+// reset the playback state so the plan can be played again from the first step
+void PRODRIVER::rewindStepPlan( PRODRIVERStepPlan &plan )
+{
+  plan.readIndex = 0;
+  plan.interval = 0;
+  plan.delta = 0;
+  plan.runRemaining = 0;
+}
+
+// stepPlanNextInterval( PRODRIVERStepPlan &plan )
+// decode the interval (in microseconds) to wait before the next step of the plan.
+// returns 0 when there are no steps left.
+// This is meant to be cheap enough to call from a timer ISR.
+uint16_t PRODRIVER::stepPlanNextInterval( PRODRIVERStepPlan &plan )
+{
+  if(plan.runRemaining == 0)
+  {
+    if(plan.readIndex >= plan.length) return 0; // finished
+
+    uint8_t code = plan.buffer[plan.readIndex++];
+    if(code == PRODRIVER_PLAN_ESCAPE)
+    {
+      plan.interval = plan.buffer[plan.readIndex] | ((uint16_t)plan.buffer[plan.readIndex + 1] << 8);
+      plan.readIndex += 2;
+      code = plan.buffer[plan.readIndex++];
+    }
+    plan.delta = (int8_t)code;
+    plan.runRemaining = plan.buffer[plan.readIndex++];
+  }
+
+  plan.interval += plan.delta;
+  plan.runRemaining--;
+  return plan.interval;
+}
+
+// stepPlanPulse( PRODRIVERStepPlan &plan )
+// take a single step of the plan, without any delays longer than a microsecond.
+// In CLOCKIN mode, this is one clock pulse (direction is set by startStepPlan()).
+// In SERIAL mode, this sends the command built at the last commitSettings() for the next phasePosition.
+// This is meant to be cheap enough to call from a timer ISR.
+// returns false if an error is detected
+bool PRODRIVER::stepPlanPulse( PRODRIVERStepPlan &plan )
+{
+  if(plan.controlMode == PRODRIVER_MODE_CLOCKIN) return clockPulse(plan.positionDelta);
+
+  // check for error
+  if(settings.errorFlag) return false;
+
+  if(advancePhase(plan.direction) == false) return false;
+  sendCommittedCommand();
+  return true;
+}
+
+// startStepPlan( PRODRIVERStepPlan &plan )
+// get ready to play back a plan made with compileStepPlan(), from the first step:
+// commits settings (if settings.autoCommit), enables the driver, sets the direction pin (CLOCKIN mode)
+// and rewinds the plan. playStepPlan() calls this for you. When stepping from
+// a timer ISR instead, call this first, then have the ISR call stepPlanNextInterval()
+// and stepPlanPulse() until the interval comes back 0.
+// The plan must have been compiled for the current controlMode and
+// (in CLOCKIN mode) the current step resolution, otherwise returns false and does nothing.
+bool PRODRIVER::startStepPlan( PRODRIVERStepPlan &plan )
+{
+  if(plan.controlMode != settings.controlMode) return false;
+  if((plan.controlMode == PRODRIVER_MODE_CLOCKIN) && (plan.stepResolution != settings.stepResolution)) return false;
+
+  if(settings.autoCommit == true) commitSettings(); // pick up any settings changed directly
+  enable();
+  if(plan.controlMode == PRODRIVER_MODE_CLOCKIN) setDirection(plan.direction);
+  rewindStepPlan(plan);
   return true;
-}
\ No newline at end of file
+}
+
+// playStepPlan( PRODRIVERStepPlan &plan )
+// play back a plan made with compileStepPlan(), from the first step.
+// returns false without stepping if the plan doesn't match (see startStepPlan()).
+// will stop if error is detected during stepping
+// retuns errorStat()
+bool PRODRIVER::playStepPlan( PRODRIVERStepPlan &plan )
+{
+  if(startStepPlan(plan) == false) return false;
+
+  uint32_t lastStepMicros = micros();
+  uint16_t interval = stepPlanNextInterval(plan);
+  while(interval != 0)
+  {
+    waitInterval(lastStepMicros, interval);
+    lastStepMicros += interval;
+    if(stepPlanPulse(plan) == false) return false; // error detected, exit out of here!
+    interval = stepPlanNextInterval(plan);
+  }
+  return errorStat();
+}
+
+// updatePositionIncrement( void )
+// work out how far (in 1/128 steps) a single step moves the motor,
+// for the current control mode and step resolution.
+void PRODRIVER::updatePositionIncrement( void )
+{
+  if(settings.controlMode == PRODRIVER_MODE_SERIAL)
+  {
+    positionIncrement = PRODRIVER_POSITION_UNITS_PER_STEP; // only 1:1 stepping
+  }
+  else if(settings.stepResolutionMode >= PRODRIVER_STEP_RESOLUTION_FIXED_FULL)
+  {
+    // fixed modes go FULL, 1/2, 1/4 ... 1/128 in order, and changeStepResolution() has no effect
+    positionIncrement = PRODRIVER_POSITION_UNITS_PER_STEP >> (settings.stepResolutionMode - PRODRIVER_STEP_RESOLUTION_FIXED_FULL);
+  }
+  else{
+    positionIncrement = PRODRIVER_POSITION_UNITS_PER_STEP / settings.stepResolution;
+  }
+}
+
+// getPosition( void )
+// returns the absolute position in 1/128 steps (see PRODRIVER_POSITION_UNITS_PER_STEP),
+// counted across both control modes and any step resolution changes.
+// (after calling begin() again, it needs setting with setPosition(), see begin())
+// position can be updated from a timer ISR (i.e. stepPlanPulse()) and is 32 bits,
+// so read it until we get the same value twice, in case an update landed halfway through.
+int32_t PRODRIVER::getPosition( void )
+{
+  int32_t first;
+  int32_t second;
+  do
+  {
+    first = position;
+    second = position;
+  } while(first != second);
+  return first;
+}
+
+// setPosition( int32_t newPosition )
+// set the absolute position (in 1/128 steps), i.e. to 0 after homing the motor
+void PRODRIVER::setPosition( int32_t newPosition )
+{
+  position = newPosition;
+}
+
+// moveBy( int32_t distance, uint8_t stepDelay )
+// move the motor distance (in 1/128 steps) from where it is now,
+// using step() or stepSerial() depending on the control mode.
+// The move has to be a whole number of steps at the current step resolution
+// (i.e. a multiple of 16 at 1:8), and has to end within the range of getPosition(),
+// otherwise returns false without moving.
+// will stop if error is detected during stepping
+// retuns errorStat()
+bool PRODRIVER::moveBy( int32_t distance, uint8_t stepDelay )
+{
+  int64_t target = (int64_t)getPosition() + distance;
+  if((target < (-2147483647LL - 1)) || (target > 2147483647LL)) return false; // would overflow position
+
+  bool direction = (distance > 0);
+  uint32_t magnitude = direction ? (uint32_t)distance : (uint32_t)0 - (uint32_t)distance; // no overflow at INT32_MIN
+  return moveSteps(magnitude, direction, stepDelay);
+}
+
+// moveTo( int32_t target, uint8_t stepDelay )
+// move the motor to an absolute position (in 1/128 steps).
+// The target has to be a whole number of steps away at the current step resolution,
+// otherwise returns false without moving (see moveBy()).
+// retuns errorStat()
+bool PRODRIVER::moveTo( int32_t target, uint8_t stepDelay )
+{
+  int64_t distance = (int64_t)target - getPosition(); // can be beyond int32_t, but its size always fits uint32_t
+  bool direction = (distance > 0);
+  uint32_t magnitude = direction ? (uint32_t)distance : (uint32_t)(-distance);
+  return moveSteps(magnitude, direction, stepDelay);
+}
+
+// moveSteps( uint32_t magnitude, bool direction, uint8_t stepDelay )
+// shared by moveBy() and moveTo(), magnitude is in 1/128 steps.
+// returns false without moving if magnitude is not a whole number of steps.
+bool PRODRIVER::moveSteps( uint32_t magnitude, bool direction, uint8_t stepDelay )
+{
+  if((magnitude % positionIncrement) != 0) return false; // can't get there at this step resolution
+  uint32_t steps = magnitude / positionIncrement;
+
+  // step() and stepSerial() take up to 65535 steps at a time
+  while(steps > 0)
+  {
+    uint16_t chunk = (steps > 0xFFFF) ? 0xFFFF : steps;
+    if(settings.controlMode == PRODRIVER_MODE_CLOCKIN)
+    {
+      if(step(chunk, direction, stepDelay) == false) return false;
+    }
+    else{
+      if(stepSerial(chunk, direction, stepDelay) == false) return false;
+    }
+    steps -= chunk;
+  }
+  return errorStat();
+}
@@ -72,6 +72,9 @@
 #define PRODRIVER_STEP_RESOLUTION_1_64 64
 #define PRODRIVER_STEP_RESOLUTION_1_128 128
 
+// position is counted in the finest microstep (1/128), so one full step is 128
+#define PRODRIVER_POSITION_UNITS_PER_STEP 128
+
 // statuses
 // used primarily to check current status
 // and avoid re-writing a pin, which causes a toggle in arduino
@@ -98,6 +101,29 @@
 #define PRODRIVER_MD_FAST_50 0x02
 #define PRODRIVER_MD_FAST_100 0x03
 
+// Step plan encoding
+// A compiled step plan is a byte stream of runs, each run is 2 bytes: [delta][count]
+// meaning "for the next count steps, add delta (signed, microseconds) to the step interval".
+// If an interval change does not fit in a signed byte, an escape is written instead:
+// [PRODRIVER_PLAN_ESCAPE][interval LSB][interval MSB], followed by a normal run.
+#define PRODRIVER_PLAN_ESCAPE 0x80
+#define PRODRIVER_PLAN_MAX_RUN 255
+
+// Compiler barrier used around the committed settings double buffer,
+// so the buffer copy can't be moved across the index/count updates.
+// (host builds with real threads can define a full fence instead)
+#ifndef PRODRIVER_MEMORY_BARRIER
+#define PRODRIVER_MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory")
+#endif
+
+// Commit counter for the settings double buffer. It has to be read in one go,
+// so it is a byte on AVR. Elsewhere it is a full word, so it can't wrap around while
+// a reader is held up (i.e. by an RTOS task switch) and make a stale copy look current.
+#if defined(__AVR__)
+typedef uint8_t PRODRIVERCommitCount;
+#else
+typedef uint32_t PRODRIVERCommitCount;
+#endif
 
 
 //  PRODRIVERSettings
@@ -135,6 +161,59 @@ struct PRODRIVERSettings
     uint8_t mixedDecayB;
     uint8_t phasePosition; // Used to keep track of phaseA/B to allow single steps in either direction
     bool fastSerialMode; // only use with 3.3V logic
+    bool autoCommit; // true = main loop functions call commitSettings() for you, set false if an ISR changes settings
+};
+
+//  PRODRIVERCommittedSettings
+//
+//  One half of the double buffer behind commitSettings() and readSettings().
+//  Holds a copy of the settings as they were committed, along with the serial
+//  command built from them (phase bits left clear, those are added on each step).
+struct PRODRIVERCommittedSettings
+{
+  public:
+    PRODRIVERSettings settings;
+    uint32_t command;
+};
+
+//  PRODRIVERSpeedProfile
+//
+//  Describes the speed of a move as step intervals (microseconds from one step to the next).
+//  The move ramps linearly from startInterval to cruiseInterval over rampSteps,
+//  cruises, and then ramps back down to startInterval over the last rampSteps.
+//  Set rampSteps to 0 (or both intervals equal) for a constant speed move.
+struct PRODRIVERSpeedProfile
+{
+  uint16_t startInterval;
+  uint16_t cruiseInterval;
+  uint16_t rampSteps;
+};
+
+//  PRODRIVERStepPlan
+//
+//  A move compiled ahead of time by compileStepPlan(), so that playback
+//  (either playStepPlan(), or startStepPlan() followed by a timer ISR calling
+//  stepPlanNextInterval() and stepPlanPulse())
+//  only needs to decode one run and do one addition per step.
+//  The user provides the storage for the encoded runs with buffer and bufferSize.
+struct PRODRIVERStepPlan
+{
+  public:
+    uint8_t *buffer; // user-supplied storage for the encoded runs
+    uint16_t bufferSize; // size of buffer in bytes
+    uint16_t length; // bytes of buffer actually used by the compiled plan
+    uint16_t steps; // total steps in the move
+    bool direction;
+    uint8_t controlMode; // control mode the plan was compiled for
+    uint8_t stepResolution; // only used in CLOCKIN mode
+    int16_t positionDelta; // change in position per step (signed by direction)
+    uint32_t compileMicros; // how long compileStepPlan() took, useful for reporting
+
+  // playback state (reset by rewindStepPlan())
+    uint16_t readIndex;
+    uint16_t interval;
+    int8_t delta;
+    uint8_t runRemaining;
 };
 
 class PRODRIVER
@@ -157,11 +236,47 @@ public:
   bool sendSerialCommand( void );
   bool setTorque( uint8_t newTorque );
   bool setCurrentLimit( uint16_t currentLimit );
+  void commitSettings( void ); // publish settings to sendSerialCommand() and the step functions
+  void commitSettings( const PRODRIVERSettings &source ); // publish a staged copy instead (i.e. from an ISR)
+  void readSettings( PRODRIVERSettings &snapshot ); // consistent copy of the last committed settings
+  uint32_t readCommittedCommand( void ); // serial command built at the last commit (phase bits clear)
+  bool stepProfile( uint16_t steps, bool direction, PRODRIVERSpeedProfile profile ); // live equivalent of playStepPlan()
+  bool compileStepPlan( PRODRIVERStepPlan &plan, uint16_t steps, bool direction, PRODRIVERSpeedProfile profile );
+  bool startStepPlan( PRODRIVERStepPlan &plan ); // call before stepping a plan from a timer ISR
+  bool playStepPlan( PRODRIVERStepPlan &plan ); // returns ERR stat
+  void rewindStepPlan( PRODRIVERStepPlan &plan );
+  uint16_t stepPlanNextInterval( PRODRIVERStepPlan &plan ); // returns 0 when the plan is finished
+  bool stepPlanPulse( PRODRIVERStepPlan &plan ); // a single step, safe to call from a timer ISR
+  int32_t getPosition( void ); // in 1/128 steps, see PRODRIVER_POSITION_UNITS_PER_STEP
+  void setPosition( int32_t newPosition = 0 ); // i.e. zero it out after homing
+  bool moveBy( int32_t distance, uint8_t stepDelay = 2 ); // distance in 1/128 steps, returns ERR stat
+  bool moveTo( int32_t target, uint8_t stepDelay = 2 ); // target in 1/128 steps, returns ERR stat
 
 
 private:
   bool pinSetup();
   bool stepSerialSingle(bool direction);
+  void setDirection(bool direction);
+  bool advancePhase(bool direction);
+  bool clockPulse( int16_t positionDelta );
+  void updatePositionIncrement( void );
+  bool moveSteps( uint32_t magnitude, bool direction, uint8_t stepDelay );
+  uint32_t buildSerialCommand( const PRODRIVERSettings &source );
+  void sendCommittedCommand( void );
+  void writeSerialCommand( uint32_t command );
+  uint16_t profileInterval( uint16_t stepIndex, uint16_t steps, PRODRIVERSpeedProfile profile );
+  void waitInterval( uint32_t lastStepMicros, uint16_t interval );
+
+  // absolute position (in 1/128 steps) and how much one step moves it at the current resolution
+  volatile int32_t position;
+  int16_t positionIncrement;
+
+  // committed settings double buffer
+  // commitSettings() fills the inactive half and then flips activeBuffer,
+  // readers retry if commitCount changes while they are copying.
+  PRODRIVERCommittedSettings committed[2];
+  volatile uint8_t activeBuffer;
+  volatile PRODRIVERCommitCount commitCount;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+/*
+  Minimal host stand-in for the Arduino core, see Arduino.h in this folder.
+*/
+
+#include "Arduino.h"
+
+uint32_t stubMicros = 0;
+int stubErrorPinLevel = HIGH;
+std::vector<StubPinEvent> stubTrace;
+
+void stubReset( void )
+{
+  stubTrace.clear();
+  stubMicros = 0;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  StubPinEvent event = {stubMicros, pin, false, mode};
+  stubTrace.push_back(event);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  StubPinEvent event = {stubMicros, pin, true, value};
+  stubTrace.push_back(event);
+}
+
+int digitalRead(uint8_t pin)
+{
+  (void)pin;
+  return stubErrorPinLevel;
+}
+
+void delay(unsigned long ms)
+{
+  stubMicros += ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  stubMicros += us;
+}
+
+unsigned long micros( void )
+{
+  return stubMicros++;
+}
@@ -0,0 +1,47 @@
+/*
+  Minimal host stand-in for Arduino.h, used only by the host tests in this folder.
+  Pin calls are recorded into stubTrace (with the time they happened) instead of
+  touching hardware, and time only moves when the library waits or calls micros().
+*/
+
+#ifndef _PRODRIVER_TEST_ARDUINO_H
+#define _PRODRIVER_TEST_ARDUINO_H
+
+#include <stdint.h>
+#include <vector>
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define LOW 0x0
+#define HIGH 0x1
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+
+// one recorded pinMode() or digitalWrite() call
+struct StubPinEvent
+{
+  uint32_t time; // stubMicros when the call was made
+  uint8_t pin;
+  bool isWrite; // false = pinMode(), true = digitalWrite()
+  uint8_t value; // mode or level
+
+  bool operator==(const StubPinEvent &other) const
+  {
+    return (time == other.time) && (pin == other.pin) && (isWrite == other.isWrite) && (value == other.value);
+  }
+};
+
+extern uint32_t stubMicros;
+extern int stubErrorPinLevel; // what digitalRead() returns, HIGH = no error
+extern std::vector<StubPinEvent> stubTrace;
+
+void stubReset( void ); // clear the trace and set time back to 0
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long micros( void ); // each call moves time on by 1uSec, so busy-waits finish
+
+#endif
@@ -0,0 +1,21 @@
+/*
+  Tiny check macro shared by the host tests in this folder.
+*/
+
+#ifndef _PRODRIVER_TEST_H
+#define _PRODRIVER_TEST_H
+
+#include <stdio.h>
+
+static int testFailures = 0;
+
+#define CHECK(condition) do { \
+    if(!(condition)) { \
+      printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+      testFailures++; \
+    } \
+  } while(0)
+
+#define TEST_RESULT() (printf("%s: %s\n", __FILE__, (testFailures == 0) ? "passed" : "FAILED"), (testFailures == 0) ? 0 : 1)
+
+#endif
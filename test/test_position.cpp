@@ -0,0 +1,165 @@
+/*
+  Host test: absolute position stays exact (in 1/128 steps) while mixing
+  step(), stepSerial(), stepProfile(), step plans and moveTo()/moveBy()
+  across step resolution changes and both control modes.
+*/
+
+#include "Arduino.h"
+#include "SparkFun_ProDriver_TC78H670FTG_Arduino_Library.h"
+#include "test.h"
+
+#define FULL PRODRIVER_POSITION_UNITS_PER_STEP
+
+static uint8_t planBuffer[256];
+
+// true if the last thing done to the direction pin (CW-CCW, aka mode3Pin) in stubTrace drove it LOW
+static bool directionPinLow(uint8_t directionPin)
+{
+  bool low = false;
+  for(size_t i = 0 ; i < stubTrace.size() ; i++)
+  {
+    if(stubTrace[i].pin != directionPin) continue;
+    if(stubTrace[i].isWrite) low = (stubTrace[i].value == LOW);
+    else low = false; // INPUT lets the pullup take it HIGH, OUTPUT is followed by a write
+  }
+  return low;
+}
+
+int main( void )
+{
+  PRODRIVERSpeedProfile profile = {100, 50, 2};
+  PRODRIVERStepPlan plan;
+  plan.buffer = planBuffer;
+  plan.bufferSize = sizeof(planBuffer);
+
+  PRODRIVER driver;
+  driver.settings.stepResolutionMode = PRODRIVER_STEP_RESOLUTION_VARIABLE_1_128;
+  driver.begin();
+  CHECK(driver.getPosition() == 0);
+
+  // CLOCKIN mode, changing resolution as we go
+  CHECK(driver.step(10, true) == true);
+  CHECK(driver.getPosition() == 10 * FULL);
+
+  CHECK(driver.changeStepResolution(PRODRIVER_STEP_RESOLUTION_1_8) == true);
+  CHECK(driver.step(3, false) == true);
+  CHECK(driver.getPosition() == 10 * FULL - 3 * 16);
+
+  CHECK(driver.changeStepResolution(PRODRIVER_STEP_RESOLUTION_1_128) == true);
+  CHECK(driver.moveTo(-5) == true);
+  CHECK(driver.getPosition() == -5);
+
+  CHECK(driver.changeStepResolution(PRODRIVER_STEP_RESOLUTION_1_2) == true);
+  CHECK(driver.moveBy(15 * 64) == true);
+  CHECK(driver.getPosition() == -5 + 15 * 64);
+
+  CHECK(driver.compileStepPlan(plan, 7, false, profile) == true);
+  CHECK(driver.playStepPlan(plan) == true);
+  CHECK(driver.getPosition() == -5 + 15 * 64 - 7 * 64);
+
+  CHECK(driver.changeStepResolution(PRODRIVER_STEP_RESOLUTION_1_4) == true);
+  CHECK(driver.stepProfile(9, true, profile) == true);
+  int32_t expected = -5 + 15 * 64 - 7 * 64 + 9 * 32;
+  CHECK(driver.getPosition() == expected);
+
+  // a timer ISR stepping a plan one pulse at a time, in the other direction to the last move,
+  // so startStepPlan() has to set the direction pin (mode3Pin driven LOW) before the first pulse
+  CHECK(driver.compileStepPlan(plan, 5, false, profile) == true);
+  stubReset();
+  CHECK(driver.startStepPlan(plan) == true);
+  while(driver.stepPlanNextInterval(plan) != 0) CHECK(driver.stepPlanPulse(plan) == true);
+  expected -= 5 * 32;
+  CHECK(driver.getPosition() == expected);
+  CHECK(directionPinLow(driver.settings.mode3Pin) == true);
+
+  CHECK(driver.step(5, true) == true); // back again
+  expected += 5 * 32;
+
+  // targets that aren't a whole number of steps away are rejected without moving
+  CHECK(driver.moveBy(16) == false);
+  CHECK(driver.moveTo(expected + 33) == false);
+  CHECK(driver.getPosition() == expected);
+
+  // invalid resolutions are rejected and don't change the position increment
+  CHECK(driver.changeStepResolution(0) == false);
+  CHECK(driver.changeStepResolution(3) == false);
+  CHECK(driver.settings.stepResolution == PRODRIVER_STEP_RESOLUTION_1_4);
+  CHECK(driver.step(2, true) == true);
+  expected += 2 * 32;
+  CHECK(driver.getPosition() == expected);
+
+  // calling begin() again boots the IC back up at 1:1, so each step is a full step again
+  CHECK(driver.changeStepResolution(PRODRIVER_STEP_RESOLUTION_1_8) == true);
+  driver.begin();
+  CHECK(driver.settings.stepResolution == PRODRIVER_STEP_RESOLUTION_1_1);
+  driver.setPosition(0); // re-homed, begin() resets the IC's electrical angle
+  CHECK(driver.step(8, true) == true);
+  CHECK(driver.getPosition() == 8 * FULL);
+  CHECK(driver.changeStepResolution(PRODRIVER_STEP_RESOLUTION_1_8) == true);
+  CHECK(driver.step(8, true) == true);
+  CHECK(driver.getPosition() == 9 * FULL);
+
+  // SERIAL mode (always 1:1), re-homed after begin() like above
+  driver.settings.controlMode = PRODRIVER_MODE_SERIAL;
+  driver.begin();
+  driver.setPosition(0);
+  expected = 0;
+  CHECK(driver.changeStepResolution(PRODRIVER_STEP_RESOLUTION_1_2) == false);
+  CHECK(driver.stepSerial(5, true) == true);
+  expected += 5 * FULL;
+  CHECK(driver.getPosition() == expected);
+
+  CHECK(driver.stepProfile(3, false, profile) == true);
+  expected -= 3 * FULL;
+  CHECK(driver.getPosition() == expected);
+
+  CHECK(driver.compileStepPlan(plan, 4, false, profile) == true);
+  CHECK(driver.playStepPlan(plan) == true);
+  expected -= 4 * FULL;
+  CHECK(driver.getPosition() == expected);
+
+  CHECK(driver.moveTo(expected - 2 * FULL) == true);
+  expected -= 2 * FULL;
+  CHECK(driver.getPosition() == expected);
+  CHECK(driver.moveBy(FULL / 2) == false); // only full steps in SERIAL mode
+  CHECK(driver.moveTo(0) == true);
+  CHECK(driver.getPosition() == 0);
+
+  // moves longer than 65535 steps, and moves that would overflow the position
+  driver.setPosition(0);
+  CHECK(driver.moveTo(70000L * FULL) == true);
+  CHECK(driver.getPosition() == 70000L * FULL);
+  driver.setPosition(2147483647L - FULL + 1);
+  CHECK(driver.moveBy(FULL) == false);
+  CHECK(driver.getPosition() == 2147483647L - FULL + 1);
+  driver.setPosition(-1);
+  CHECK(driver.moveBy(-2147483647L - 1) == false);
+  CHECK(driver.getPosition() == -1);
+  driver.setPosition(2147483647L);
+  CHECK(driver.moveTo(-2147483647L - 1) == false); // 2^32 - 1 away, not a whole number of steps
+  CHECK(driver.getPosition() == 2147483647L);
+  driver.setPosition(-2147483647L - 1 + FULL);
+  CHECK(driver.moveBy(-FULL) == true);
+  CHECK(driver.getPosition() == -2147483647L - 1);
+  driver.setPosition(-2147483647L - 1);
+  CHECK(driver.moveTo(-2147483647L - 1) == true); // already there
+
+  // fixed step resolution modes count their own resolution, and can't be changed
+  PRODRIVER fixed;
+  fixed.settings.stepResolutionMode = PRODRIVER_STEP_RESOLUTION_FIXED_1_16;
+  fixed.begin();
+  CHECK(fixed.changeStepResolution(PRODRIVER_STEP_RESOLUTION_1_2) == false);
+  CHECK(fixed.step(16, true) == true);
+  CHECK(fixed.getPosition() == FULL);
+
+  // variable modes only allow resolutions up to their finest
+  PRODRIVER variable;
+  variable.settings.stepResolutionMode = PRODRIVER_STEP_RESOLUTION_VARIABLE_1_8;
+  variable.begin();
+  CHECK(variable.changeStepResolution(PRODRIVER_STEP_RESOLUTION_1_16) == false);
+  CHECK(variable.changeStepResolution(PRODRIVER_STEP_RESOLUTION_1_8) == true);
+  CHECK(variable.moveTo(-3 * FULL) == true);
+  CHECK(variable.getPosition() == -3 * FULL);
+
+  return TEST_RESULT();
+}
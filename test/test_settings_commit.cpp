@@ -0,0 +1,170 @@
+/*
+  Host test: committed settings are always read as one complete set.
+  A writer thread commits distinct (currentLimA, currentLimB, torque) sets while
+  a reader thread checks that every snapshot it sees is one of them, never a mix.
+  Also checks that changing settings directly and then calling sendSerialCommand()
+  still sends the new values, and that with autoCommit off the main loop only sends
+  sets an "ISR" thread staged and committed with commitSettings(staged).
+*/
+
+#include "Arduino.h"
+#include "SparkFun_ProDriver_TC78H670FTG_Arduino_Library.h"
+#include "test.h"
+#include <atomic>
+#include <thread>
+
+#define COMMITS 2000000
+
+// every committed set is worked out from a single number, so a reader can tell if it got a mix
+static uint16_t limitA(uint32_t k) { return k & 0x3FF; }
+static uint16_t limitB(uint32_t k) { return 1023 - (k & 0x3FF); }
+static uint8_t torqueFor(uint32_t k) { return (limitA(k) >> 2) & 0x03; }
+
+static bool isCommittedSet(uint16_t currentLimA, uint16_t currentLimB, uint8_t torque)
+{
+  return (currentLimB == 1023 - currentLimA) && (torque == ((currentLimA >> 2) & 0x03));
+}
+
+static bool isCommittedSet(uint16_t currentLimA, uint16_t currentLimB, uint8_t torque, uint32_t k)
+{
+  return (currentLimA == limitA(k)) && (currentLimB == limitB(k)) && (torque == torqueFor(k));
+}
+
+// shift-out order in fast serial mode is bit 0 first, one write to the data pin (mode0Pin) per bit
+static uint32_t lastCommandSent(uint8_t dataPin)
+{
+  uint32_t command = 0;
+  uint8_t bit = 0;
+  for(size_t i = 0 ; i < stubTrace.size() ; i++)
+  {
+    if(stubTrace[i].isWrite && (stubTrace[i].pin == dataPin))
+    {
+      if(stubTrace[i].value == HIGH) command |= ((uint32_t)1 << bit);
+      bit++;
+    }
+  }
+  return (bit == 32) ? command : 0xFFFFFFFF;
+}
+
+int main( void )
+{
+  PRODRIVER driver;
+  driver.settings.controlMode = PRODRIVER_MODE_SERIAL;
+  driver.begin();
+
+  std::atomic<bool> done(false);
+  long torn = 0;
+  long snapshots = 0;
+
+  std::thread writer([&]()
+  {
+    for(uint32_t i = 0 ; i < COMMITS ; i++)
+    {
+      uint32_t k = i * 2654435761u; // spread the sets out so neighbours differ in every field
+      driver.settings.currentLimA = limitA(k);
+      driver.settings.currentLimB = limitB(k);
+      driver.settings.torque = torqueFor(k);
+      driver.commitSettings();
+    }
+    done = true;
+  });
+
+  std::thread reader([&]()
+  {
+    PRODRIVERSettings snapshot;
+    while(done == false)
+    {
+      driver.readSettings(snapshot);
+      if(!isCommittedSet(snapshot.currentLimA, snapshot.currentLimB, snapshot.torque)) torn++;
+
+      uint32_t command = driver.readCommittedCommand();
+      uint16_t currentLimA = (command >> 3) & 0x3FF;
+      uint16_t currentLimB = (command >> 19) & 0x3FF;
+      uint8_t torque = (command >> 29) & 0x03;
+      if(!isCommittedSet(currentLimA, currentLimB, torque)) torn++;
+      snapshots++;
+    }
+  });
+
+  writer.join();
+  reader.join();
+  printf("%ld snapshots read during %d commits\n", snapshots, COMMITS);
+  CHECK(snapshots > 0);
+  CHECK(torn == 0);
+
+  // after the writer is done, the last commit is what we read back
+  uint32_t last = (COMMITS - 1) * 2654435761u;
+  PRODRIVERSettings snapshot;
+  driver.readSettings(snapshot);
+  CHECK(isCommittedSet(snapshot.currentLimA, snapshot.currentLimB, snapshot.torque, last));
+
+  // direct changes are picked up by sendSerialCommand()
+  driver.settings.fastSerialMode = true;
+  driver.settings.currentLimA = 100;
+  driver.settings.currentLimB = 200;
+  driver.settings.torque = PRODRIVER_TRQ_50;
+  driver.settings.mixedDecayA = PRODRIVER_MD_FAST_75;
+  driver.settings.openDetection = PRODRIVER_OPD_ON;
+  stubReset();
+  driver.sendSerialCommand();
+  uint32_t sent = lastCommandSent(driver.settings.mode0Pin);
+  CHECK(((sent >> 3) & 0x3FF) == 100);
+  CHECK(((sent >> 19) & 0x3FF) == 200);
+  CHECK(((sent >> 29) & 0x03) == PRODRIVER_TRQ_50);
+  CHECK((sent & 0x03) == PRODRIVER_MD_FAST_75);
+  CHECK((sent >> 31) == PRODRIVER_OPD_ON);
+  CHECK((driver.readCommittedCommand() | (1UL << 2) | (1UL << 18)) == sent); // phase position 1, both phases plus
+
+  // and by stepSerial(), along with the phase bits for each step
+  driver.settings.currentLimA = 300;
+  stubReset();
+  driver.stepSerial(1, true); // phase position 1 -> 2
+  sent = lastCommandSent(driver.settings.mode0Pin);
+  CHECK(((sent >> 3) & 0x3FF) == 300);
+  CHECK(((sent >> 2) & 0x01) == 0); // phaseA minus
+  CHECK(((sent >> 18) & 0x01) == 1); // phaseB plus
+
+  // an "ISR" that owns the settings: it stages its own copy and commits that,
+  // while also leaving the live settings half-changed (currentLimB never matches).
+  // With autoCommit off, the main loop's sendSerialCommand() never copies the live
+  // settings, so every frame it sends is one of the staged sets.
+  driver.settings.autoCommit = false;
+  PRODRIVERSettings staged = driver.settings;
+  staged.currentLimA = limitA(0);
+  staged.currentLimB = limitB(0);
+  staged.torque = torqueFor(0);
+  driver.commitSettings(staged); // so the first frames are from a staged set too
+  done = false;
+
+  std::thread isr([&]()
+  {
+    for(uint32_t i = 0 ; i < COMMITS / 4 ; i++)
+    {
+      uint32_t k = i * 2654435761u;
+      staged.currentLimA = limitA(k);
+      staged.currentLimB = limitB(k);
+      staged.torque = torqueFor(k);
+      driver.commitSettings(staged);
+      driver.settings.currentLimA = limitA(k);
+      driver.settings.currentLimB = limitA(k);
+    }
+    done = true;
+  });
+
+  long frames = 0;
+  long tornFrames = 0;
+  while(done == false)
+  {
+    stubReset();
+    driver.sendSerialCommand();
+    sent = lastCommandSent(driver.settings.mode0Pin);
+    if(!isCommittedSet((sent >> 3) & 0x3FF, (sent >> 19) & 0x3FF, (sent >> 29) & 0x03)) tornFrames++;
+    frames++;
+  }
+  isr.join();
+  printf("%ld frames sent during %d staged commits\n", frames, COMMITS / 4);
+  CHECK(frames > 0);
+  CHECK(tornFrames == 0);
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,119 @@
+/*
+  Host test: a compiled step plan plays back the exact same pin trace
+  (every pin call, at the same time) as stepProfile() working it out live.
+*/
+
+#include "Arduino.h"
+#include "SparkFun_ProDriver_TC78H670FTG_Arduino_Library.h"
+#include "test.h"
+
+static uint8_t planBuffer[1024];
+
+// a driver ready to step, in the given control mode and step resolution
+static void setupDriver(PRODRIVER &driver, uint8_t controlMode, uint8_t resolution)
+{
+  driver.settings.controlMode = controlMode;
+  driver.settings.stepResolutionMode = PRODRIVER_STEP_RESOLUTION_VARIABLE_1_128;
+  driver.begin();
+  if(controlMode == PRODRIVER_MODE_CLOCKIN) driver.changeStepResolution(resolution);
+  driver.enable();
+}
+
+// every plan starts with one escape (the first interval), count how many there are
+static uint16_t countEscapes(const PRODRIVERStepPlan &plan)
+{
+  uint16_t escapes = 0;
+  uint16_t i = 0;
+  while(i < plan.length)
+  {
+    if(plan.buffer[i] == PRODRIVER_PLAN_ESCAPE)
+    {
+      escapes++;
+      i += 3;
+    }
+    i += 2; // the run
+  }
+  return escapes;
+}
+
+static void checkSameTrace(uint8_t controlMode, uint8_t resolution, uint16_t steps, bool direction, PRODRIVERSpeedProfile profile, bool expectMidMoveEscape)
+{
+  PRODRIVER live;
+  setupDriver(live, controlMode, resolution);
+  stubReset();
+  CHECK(live.stepProfile(steps, direction, profile) == true);
+  std::vector<StubPinEvent> liveTrace = stubTrace;
+
+  PRODRIVER played;
+  setupDriver(played, controlMode, resolution);
+  PRODRIVERStepPlan plan;
+  plan.buffer = planBuffer;
+  plan.bufferSize = sizeof(planBuffer);
+  CHECK(played.compileStepPlan(plan, steps, direction, profile) == true);
+  CHECK(plan.steps == steps);
+  if(expectMidMoveEscape) CHECK(countEscapes(plan) > 1);
+  else CHECK(countEscapes(plan) == 1);
+  stubReset();
+  CHECK(played.playStepPlan(plan) == true);
+
+  CHECK(liveTrace.size() > 0);
+  CHECK(stubTrace == liveTrace);
+  CHECK(played.settings.phasePosition == live.settings.phasePosition);
+}
+
+int main( void )
+{
+  PRODRIVERSpeedProfile ramp = {2000, 300, 100}; // -17uSec per step, encodes as long runs
+  PRODRIVERSpeedProfile constant = {500, 500, 0};
+  PRODRIVERSpeedProfile steepRamp = {60000, 10, 50}; // changes too big for a signed byte, needs escapes
+
+  for(uint8_t controlMode = PRODRIVER_MODE_CLOCKIN ; controlMode <= PRODRIVER_MODE_SERIAL ; controlMode++)
+  {
+    checkSameTrace(controlMode, PRODRIVER_STEP_RESOLUTION_1_1, 1, true, ramp, false);
+    checkSameTrace(controlMode, PRODRIVER_STEP_RESOLUTION_1_1, 300, true, ramp, false);
+    checkSameTrace(controlMode, PRODRIVER_STEP_RESOLUTION_1_8, 1000, false, ramp, false);
+    checkSameTrace(controlMode, PRODRIVER_STEP_RESOLUTION_1_8, 700, true, constant, false);
+    checkSameTrace(controlMode, PRODRIVER_STEP_RESOLUTION_1_1, 300, false, steepRamp, true);
+  }
+
+  // a plan that doesn't fit is left empty, so playing it does nothing
+  PRODRIVER driver;
+  setupDriver(driver, PRODRIVER_MODE_CLOCKIN, PRODRIVER_STEP_RESOLUTION_1_1);
+  PRODRIVERStepPlan plan;
+  plan.buffer = planBuffer;
+  plan.bufferSize = 8;
+  CHECK(driver.compileStepPlan(plan, 400, 0, steepRamp) == false);
+  CHECK(plan.length == 0);
+  CHECK(plan.steps == 0);
+  CHECK(plan.compileMicros == 0);
+  CHECK(driver.stepPlanNextInterval(plan) == 0);
+  int32_t position = driver.getPosition();
+  CHECK(driver.playStepPlan(plan) == true);
+  CHECK(driver.getPosition() == position);
+
+  // a plan compiled at another step resolution is rejected without stepping
+  plan.bufferSize = sizeof(planBuffer);
+  CHECK(driver.compileStepPlan(plan, 400, 0, ramp) == true);
+  driver.changeStepResolution(PRODRIVER_STEP_RESOLUTION_1_4);
+  CHECK(driver.playStepPlan(plan) == false);
+  CHECK(driver.getPosition() == position);
+
+  // and a plan compiled for the other control mode
+  PRODRIVER serialDriver;
+  setupDriver(serialDriver, PRODRIVER_MODE_SERIAL, PRODRIVER_STEP_RESOLUTION_1_1);
+  CHECK(serialDriver.playStepPlan(plan) == false);
+
+  // an out of range phasePosition is rejected, not used to index the phase tables
+  PRODRIVERStepPlan serialPlan;
+  serialPlan.buffer = planBuffer;
+  serialPlan.bufferSize = sizeof(planBuffer);
+  CHECK(serialDriver.compileStepPlan(serialPlan, 3, false, ramp) == true);
+  serialDriver.settings.phasePosition = 0;
+  CHECK(serialDriver.stepSerial(1, false) == false);
+  CHECK(serialDriver.playStepPlan(serialPlan) == false);
+  serialDriver.settings.phasePosition = 255;
+  CHECK(serialDriver.stepSerial(1, true) == false);
+  CHECK(serialDriver.settings.phasePosition == 255);
+
+  return TEST_RESULT();
+}